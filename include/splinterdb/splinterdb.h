@@ -69,10 +69,51 @@ typedef struct splinterdb_config {
    int    io_flags;
    uint32 io_perms;
    uint64 io_async_queue_depth;
+   _Bool  io_use_uring;    // Issue async IO with io_uring instead of libaio
+   _Bool  io_uring_sqpoll; // io_uring: a kernel thread polls for submissions
+   // Per thread bound on in-flight background IO (prefetch, compaction and
+   // cache writeback), so it can't crowd out lookups' cache misses. Default
+   // is half of io_async_queue_depth.
+   uint64 io_max_background_inflight;
+
+   // Additional files/devices to stripe the database across. Extents are
+   // spread round-robin over filename and these, in this order, which must
+   // be the same on every open. At most 7 may be given.
+   const char *const *stripe_filenames;
+   uint64             num_stripe_filenames;
 
    // cache
    _Bool       cache_use_stats;
    const char *cache_logfile;
+   // Caps the rate at which memtable and compaction output is written back, in
+   // bytes per second. Lifted while inserts wait on memtables. 0 = unlimited.
+   uint64 cache_write_bytes_per_sec;
+   // Poll for the completion of cache misses rather than block in the kernel,
+   // trading CPU for wakeup latency on fast devices.
+   _Bool cache_use_polled_reads;
+   // Index cached pages with a hash table sized by the cache, rather than a
+   // table with 4 bytes for every page of the disk. For very large disks.
+   _Bool cache_use_hashed_lookup;
+   // Keep hot pages cached through range scans and compactions, which are
+   // loaded cold, and protect pages that are used again for longer.
+   _Bool cache_use_scan_resistance;
+   // Bytes of the cache kept for trunk nodes and for filters, which are on
+   // the path of every point lookup. Pages of these types are not evicted
+   // while they fit in the reservation. Together at most half the cache.
+   uint64 cache_trunk_reserve_size;
+   uint64 cache_filter_reserve_size;
+   // Back the cache with huge pages, to cut TLB misses in large caches. A
+   // cache_huge_page_size of 2MB or 1GB uses pages reserved by the admin in
+   // /sys/kernel/mm/hugepages, 0 or their shortage transparent huge pages.
+   _Bool  cache_use_huge_pages;
+   uint64 cache_huge_page_size;
+   // Split the cache by NUMA node, placing each part in its node's memory,
+   // with threads loading pages into the part of the node they run on.
+   _Bool cache_use_numa;
+   // The size splinterdb_cache_resize() can grow the cache to, 0 for
+   // cache_size. Memory is only used for the current size, except that the
+   // io_uring backend pins the pages up to the maximum.
+   uint64 cache_max_size;
 
    // task system
    // Background threads configuration:
@@ -211,15 +252,122 @@ splinterdb_insert(const splinterdb *kvsb, slice key, slice value);
 int
 splinterdb_delete(const splinterdb *kvsb, slice key);
 
+// Delete every key in [start_key, end_key), or every key from start_key on
+// if end_key is NULL_SLICE. Nothing is deleted if start_key >= end_key.
+//
+// The cost doesn't grow with the number of keys in the range: the range is
+// recorded and masks the older values of its keys until compaction removes
+// them. Outstanding range deletes are saved by splinterdb_close().
+int
+splinterdb_delete_range(const splinterdb *kvs, slice start_key, slice end_key);
+
 // Insert a key and value.
 // Relies on data_config->encode_message
 int
 splinterdb_update(const splinterdb *kvsb, slice key, slice delta);
 
+/*
+Write batches
+
+A write batch accumulates inserts, deletes and updates, copying the keys and
+values into the batch, so the caller's buffers may be reused immediately.
+splinterdb_write_batch_apply() then applies the whole batch at once, taking
+the memtable insert lock once rather than once per message. The messages of a
+batch always land in the same memtable, so a batch is never split by a
+memtable flush, and later messages in a batch take precedence over earlier
+ones for the same key.
+
+Applying a batch is not atomic. Readers on other threads may observe a batch
+while it is being applied, each message is logged separately, and an error
+part way through leaves the messages before it applied.
+
+The memtable insert lock is held while the batch is applied, which delays
+memtable rotation, so very large batches should be split up.
+
+A write batch may be applied any number of times, and reused after
+splinterdb_write_batch_clear(). It is not safe to use from multiple threads.
+*/
+typedef struct splinterdb_write_batch splinterdb_write_batch;
+
+// Create an empty write batch for use with kvs
+int
+splinterdb_write_batch_create(const splinterdb        *kvs,  // IN
+                              splinterdb_write_batch **batch // OUT
+);
+
+void
+splinterdb_write_batch_destroy(splinterdb_write_batch *batch);
+
+// Add an insert of key and value to the batch.
+int
+splinterdb_write_batch_insert(splinterdb_write_batch *batch,
+                              slice                   key,
+                              slice                   value);
+
+// Add a delete of key to the batch.
+int
+splinterdb_write_batch_delete(splinterdb_write_batch *batch, slice key);
+
+// Add an update of key by delta to the batch.
+int
+splinterdb_write_batch_update(splinterdb_write_batch *batch,
+                              slice                   key,
+                              slice                   delta);
+
+// Returns the number of messages in the batch
+uint64
+splinterdb_write_batch_count(const splinterdb_write_batch *batch);
+
+// Remove all messages from the batch
+void
+splinterdb_write_batch_clear(splinterdb_write_batch *batch);
+
+// Apply all the messages in the batch, in the order they were added.
+//
+// If any key is too large, nothing is applied and EINVAL is returned. Any
+// other error stops the batch at the failing message, leaving the ones before
+// it applied.
+int
+splinterdb_write_batch_apply(const splinterdb             *kvs,  // IN
+                             const splinterdb_write_batch *batch // IN
+);
+
+/*
+Bulk loading
+
+splinterdb_bulk_load() loads a stream of key-value pairs that is already
+sorted, building the on-disk trees directly rather than inserting the pairs
+one at a time through the memtable. This is much cheaper for initial loads of
+large data sets.
+
+The stream is read by calling next(arg, &key, &value) until it returns false.
+The key and value it returns need only remain valid until the following call.
+Keys must be strictly increasing according to the data_config's key_compare.
+
+Bulk-loaded pairs are ordered before any writes which have not yet been
+flushed from the memtable, so the latter take precedence. Intended use is to
+load into an empty database or into a key range that is not being written
+concurrently.
+*/
+typedef _Bool (*splinterdb_bulk_load_next_fn)(void  *arg,
+                                              slice *key,  // OUT
+                                              slice *value // OUT
+);
+
+// Load the sorted stream produced by next.
+//
+// Returns EINVAL if a key is too large or out of order, in which case the
+// pairs before it have been loaded and the stream is not read any further.
+int
+splinterdb_bulk_load(const splinterdb            *kvs,  // IN
+                     splinterdb_bulk_load_next_fn next, // IN
+                     void                        *arg   // IN
+);
+
 // Lookups
 
 // Size of opaque data required to hold a lookup result
-#define SPLINTERDB_LOOKUP_BUFSIZE (6 * sizeof(void *))
+#define SPLINTERDB_LOOKUP_BUFSIZE (12 * sizeof(void *))
 
 // A lookup result is stored and parsed from here
 //
@@ -244,8 +392,8 @@ typedef struct {
 // 2. The lifetime of *result must not exceed the lifetime of kvs
 //    The result should be deinit'ed before calling splinterdb_close on kvs
 //
-// While the current version of SplinterDB does not rely on these rules, future
-// versions may store pointers to Splinter's own memory in the lookup_result.
+// A result filled in by splinterdb_lookup_pinned() holds a pointer into
+// Splinter's cache, so these rules must be followed.
 void
 splinterdb_lookup_result_init(const splinterdb         *kvs,        // IN
                               splinterdb_lookup_result *result,     // IN/OUT
@@ -281,6 +429,116 @@ splinterdb_lookup(const splinterdb         *kvs,   // IN
                   splinterdb_lookup_result *result // IN/OUT
 );
 
+// Lookup a key without copying its value
+//
+// Same as splinterdb_lookup(), except that when the value is stored whole in
+// a single on-disk tree leaf, splinterdb_lookup_result_value() returns a
+// slice pointing into the cache page holding it, saving a copy of the value.
+// Values that are still in the memtable or that must be merged from several
+// updates are copied as usual.
+//
+// The page stays pinned in the cache until result is used for another
+// lookup or deinit'ed, which must be done by the thread that did the lookup.
+// A pinned page can't be evicted, so don't hold many results at once.
+int
+splinterdb_lookup_pinned(const splinterdb         *kvs,   // IN
+                         slice                     key,   // IN
+                         splinterdb_lookup_result *result // IN/OUT
+);
+
+// Lookup the messages for a batch of keys
+//
+// On success, results[i] holds the answer for keys[i], exactly as if
+// splinterdb_lookup() had been called for each key in turn. The keys need not
+// be sorted and may contain duplicates. Looking up keys together is cheaper
+// than looking them up one at a time: keys that share a path through the tree
+// share the work of walking it, and reads of tree nodes missing from the cache
+// are issued concurrently.
+//
+// Each result must have first been initialized using
+// splinterdb_lookup_result_init
+int
+splinterdb_multi_lookup(const splinterdb         *kvs,      // IN
+                        uint64                    num_keys, // IN
+                        const slice              *keys,     // IN
+                        splinterdb_lookup_result *results   // IN/OUT
+);
+
+/*
+Asynchronous lookups
+
+splinterdb_lookup() blocks the calling thread on every cache miss, so a
+thread can have at most one I/O outstanding. The asynchronous interface lets
+a single thread keep many lookups in flight at once:
+
+- Each outstanding lookup needs its own splinterdb_lookup_async_ctxt, which
+  holds the state of the lookup across I/Os. Contexts may be reused once the
+  lookup they were used for has completed.
+- splinterdb_lookup_async() starts a lookup. If the answer is available
+  without I/O, the callback is invoked before it returns.
+- splinterdb_lookup_async_poll() reaps I/O completions for the calling thread
+  and advances its outstanding lookups, invoking the callback of each lookup
+  that completes. It returns the number of lookups still outstanding.
+
+Lookups are driven only by the thread that started them, so that thread must
+keep polling until all of its lookups have completed.
+
+Sample application code:
+
+   for (i = 0; i < n; i++) {
+      rc = splinterdb_lookup_async(kvs, ctxt[i], key[i], &result[i], cb, arg);
+      if (rc == EAGAIN) { ... poll and try again ... }
+   }
+   while (splinterdb_lookup_async_poll(kvs) > 0) {
+      // do other useful work
+   }
+*/
+
+// Max number of async lookups a thread may have outstanding at once
+#define SPLINTERDB_LOOKUP_ASYNC_MAX_INFLIGHT 128
+
+typedef struct splinterdb_lookup_async_ctxt splinterdb_lookup_async_ctxt;
+
+// Invoked on the thread that started the lookup, once the lookup is done.
+// result is the one passed to splinterdb_lookup_async() and may be parsed
+// with splinterdb_lookup_found() and splinterdb_lookup_result_value().
+typedef void (*splinterdb_lookup_async_cb)(splinterdb_lookup_result *result,
+                                           int                       rc,
+                                           void                     *arg);
+
+// Allocate a context for one outstanding async lookup
+int
+splinterdb_lookup_async_ctxt_create(const splinterdb              *kvs, // IN
+                                    splinterdb_lookup_async_ctxt **ctxt // OUT
+);
+
+// Free a context. The lookup it was used for must have completed.
+void
+splinterdb_lookup_async_ctxt_destroy(splinterdb_lookup_async_ctxt *ctxt);
+
+// Start an async lookup of key
+//
+// The key is copied, but result must remain valid until cb is invoked.
+//
+// Returns 0 if the lookup was started (or has already completed), EAGAIN if
+// this thread already has SPLINTERDB_LOOKUP_ASYNC_MAX_INFLIGHT lookups
+// outstanding, or another error number on failure, in which case cb will
+// not be invoked.
+int
+splinterdb_lookup_async(const splinterdb             *kvs,    // IN
+                        splinterdb_lookup_async_ctxt *ctxt,   // IN
+                        slice                         key,    // IN
+                        splinterdb_lookup_result     *result, // IN/OUT
+                        splinterdb_lookup_async_cb    cb,     // IN
+                        void                         *cb_arg  // IN
+);
+
+// Drive progress on the calling thread's outstanding async lookups.
+//
+// Returns the number of lookups still outstanding on this thread.
+uint64
+splinterdb_lookup_async_poll(const splinterdb *kvs);
+
 
 /*
 Iterator API (range query)
@@ -345,6 +603,38 @@ splinterdb_iterator_init(const splinterdb     *kvs,      // IN
                          slice                 start_key // IN
 );
 
+// Initialize a new iterator over the keys in [start_key, end_key), or
+// [start_key, end_key] if end_inclusive is true.
+//
+// If start_key is NULL_SLICE, the iterator will start before the minimum key.
+// If end_key is NULL_SLICE, the range is unbounded above.
+//
+// Prefer this to checking keys against an end key in the application: the
+// iterator will not read any part of the database beyond end_key, which
+// saves considerable I/O for short scans.
+int
+splinterdb_iterator_init_range(const splinterdb     *kvs,          // IN
+                               splinterdb_iterator **iter,         // OUT
+                               slice                 start_key,    // IN
+                               slice                 end_key,      // IN
+                               _Bool                 end_inclusive // IN
+);
+
+// Initialize a new iterator over the keys that begin with the given prefix.
+//
+// This is a range iterator over [prefix, successor(prefix)), where the
+// successor is the prefix with trailing 0xff bytes dropped and its last
+// byte incremented. It is therefore only meaningful for key comparators that
+// order keys lexicographically by bytes, like the default_data_config; with
+// other comparators, use splinterdb_iterator_init_range() directly.
+//
+// An empty prefix iterates over all keys.
+int
+splinterdb_iterator_init_prefix(const splinterdb     *kvs,   // IN
+                                splinterdb_iterator **iter,  // OUT
+                                slice                 prefix // IN
+);
+
 // Deinitialize an iterator
 //
 // Failing to do this may cause hangs.
@@ -404,6 +694,48 @@ splinterdb_iterator_get_current(splinterdb_iterator *iter, // IN
 int
 splinterdb_iterator_status(const splinterdb_iterator *iter);
 
+/*
+ * Snapshots
+ *
+ * A snapshot is a consistent, read-only view of the database as of its
+ * creation: it reflects every insert, update and delete that completed
+ * before splinterdb_snapshot_create() was called, and none issued after it
+ * returns. Reads from a snapshot are unaffected by concurrent writes.
+ *
+ * Creating a snapshot flushes the current memtable into the on-disk tree
+ * and waits for that to finish, so it costs about as much as a memtable
+ * flush. Holding a snapshot copies no data and does not block writers, but
+ * it keeps the disk space of data replaced or deleted since its creation
+ * from being reclaimed, so long-lived snapshots increase space use.
+ *
+ * Snapshots must be released before splinterdb_close(), and iterators over a
+ * snapshot must be deinitialized before it is released.
+ */
+typedef struct splinterdb_snapshot splinterdb_snapshot;
+
+int
+splinterdb_snapshot_create(const splinterdb     *kvs,     // IN
+                           splinterdb_snapshot **snapshot // OUT
+);
+
+void
+splinterdb_snapshot_release(splinterdb_snapshot *snapshot);
+
+// Like splinterdb_lookup(), but reads from the snapshot
+int
+splinterdb_snapshot_lookup(const splinterdb_snapshot *snapshot, // IN
+                           slice                      key,      // IN
+                           splinterdb_lookup_result  *result    // IN/OUT
+);
+
+// Like splinterdb_iterator_init_range(), but iterates over the snapshot
+int
+splinterdb_snapshot_iterator_init(const splinterdb_snapshot *snapshot,
+                                  splinterdb_iterator      **iter,
+                                  slice                      start_key,
+                                  slice                      end_key,
+                                  _Bool                      end_inclusive);
+
 /*
  * Statistics Printing
  *
@@ -422,4 +754,142 @@ splinterdb_stats_print_lookup(const splinterdb *kvs);
 void
 splinterdb_stats_reset(splinterdb *kvs);
 
+/*
+ * Statistics Snapshot
+ *
+ * splinterdb_stats_get() fills in a splinterdb_stats with the counters behind
+ * the printed statistics, summed over all threads, for applications that
+ * sample them periodically. It allocates nothing and doesn't block other
+ * operations, so it is cheap enough to call every second.
+ *
+ * The caller sets stats->version to SPLINTERDB_STATS_VERSION before the call.
+ * Fields are only ever appended, and a library fills in only the fields of
+ * the version the caller was built with.
+ *
+ * Tree counters are zero unless the use_stats config option is set, and
+ * cache counters are zero unless cache_use_stats is set. All counters are
+ * cumulative since open or the last splinterdb_stats_reset().
+ *
+ * Device IO counters (version 2) are kept with use_stats, by kind of IO. An
+ * IO's latency runs from when it is issued to when it completes, including
+ * any time it is queued behind other IOs of its thread. Percentiles are
+ * upper bounds, from a histogram with roughly 1-2-5 steps. The depth is the
+ * number of async IOs in flight, sampled as each one is issued: a high depth
+ * with high latency points at the device, low depth at the layers above it.
+ *
+ * With cache_use_polled_reads, the cache misses read by polling (version 3)
+ * are counted apart. A sample of the misses are still blocking reads, so
+ * their mean latency can be compared with the rest of cache_misses.
+ *
+ * Trunk and filter pages (version 4) are also counted apart, to size
+ * cache_trunk_reserve_size and cache_filter_reserve_size. Their resident
+ * pages are those in the cache at the time of the call, kept without
+ * cache_use_stats; reserve skips count evictions the reservations prevented.
+ */
+#define SPLINTERDB_STATS_VERSION    4
+#define SPLINTERDB_STATS_MAX_HEIGHT 8
+
+typedef enum splinterdb_io_kind {
+   SPLINTERDB_IO_SYNC_PAGE_READ = 0,
+   SPLINTERDB_IO_SYNC_PAGE_WRITE,
+   SPLINTERDB_IO_SYNC_EXTENT_READ, // IOs of more than a page
+   SPLINTERDB_IO_SYNC_EXTENT_WRITE,
+   SPLINTERDB_IO_ASYNC_PAGE_READ,
+   SPLINTERDB_IO_ASYNC_PAGE_WRITE,
+   SPLINTERDB_IO_ASYNC_EXTENT_READ,
+   SPLINTERDB_IO_ASYNC_EXTENT_WRITE,
+   SPLINTERDB_IO_NUM_KINDS,
+} splinterdb_io_kind;
+
+typedef struct splinterdb_stats {
+   uint64 version; // IN: SPLINTERDB_STATS_VERSION
+
+   // Operations
+   uint64 insertions;
+   uint64 updates;
+   uint64 deletions;
+   uint64 lookups_found;
+   uint64 lookups_not_found;
+
+   // Memtable flushes into the root of the tree
+   uint64 memtable_flushes;
+   uint64 memtable_flush_time_ns;
+   uint64 memtable_flush_wait_time_ns;
+   uint64 root_full_stalls; // flushes that waited for the root to flush
+
+   // Flushes, compactions and lookups, by height of the tree node (0 is the
+   // leaves). Entries above height are zero. The root is counted separately.
+   uint64 height;
+   uint64 flushes[SPLINTERDB_STATS_MAX_HEIGHT];
+   uint64 flush_time_ns[SPLINTERDB_STATS_MAX_HEIGHT];
+   uint64 compactions[SPLINTERDB_STATS_MAX_HEIGHT];
+   uint64 compaction_tuples[SPLINTERDB_STATS_MAX_HEIGHT];
+   uint64 compaction_time_ns[SPLINTERDB_STATS_MAX_HEIGHT];
+   uint64 filter_lookups[SPLINTERDB_STATS_MAX_HEIGHT];
+   uint64 filter_false_positives[SPLINTERDB_STATS_MAX_HEIGHT];
+   uint64 branch_lookups[SPLINTERDB_STATS_MAX_HEIGHT];
+   uint64 root_flushes;
+   uint64 root_flush_time_ns;
+   uint64 root_compactions;
+   uint64 root_compaction_tuples;
+   uint64 root_compaction_time_ns;
+   uint64 index_splits;
+   uint64 leaf_splits;
+
+   // Cache, over all page types
+   uint64 cache_hits;
+   uint64 cache_misses;
+   uint64 cache_miss_time_ns;
+   uint64 prefetches_issued;
+   uint64 pages_read;
+   uint64 pages_written;
+   uint64 io_read_bytes;
+   uint64 io_write_bytes;
+
+   // Version 2: device IO, indexed by splinterdb_io_kind
+   uint64 io_count[SPLINTERDB_IO_NUM_KINDS];
+   uint64 io_latency_total_ns[SPLINTERDB_IO_NUM_KINDS];
+   uint64 io_latency_max_ns[SPLINTERDB_IO_NUM_KINDS];
+   uint64 io_latency_p50_ns[SPLINTERDB_IO_NUM_KINDS];
+   uint64 io_latency_p99_ns[SPLINTERDB_IO_NUM_KINDS];
+   uint64 io_depth_samples;
+   uint64 io_depth_total;
+   uint64 io_depth_max;
+   uint64 io_depth_p99;
+
+   // Version 3: cache misses read with cache_use_polled_reads
+   uint64 cache_polled_misses;
+   uint64 cache_polled_miss_time_ns;
+
+   // Version 4: trunk and filter pages in the cache
+   uint64 cache_trunk_hits;
+   uint64 cache_trunk_misses;
+   uint64 cache_trunk_resident_pages;
+   uint64 cache_trunk_reserve_skips;
+   uint64 cache_filter_hits;
+   uint64 cache_filter_misses;
+   uint64 cache_filter_resident_pages;
+   uint64 cache_filter_reserve_skips;
+} splinterdb_stats;
+
+// Returns EINVAL if stats->version is not a version this library knows
+int
+splinterdb_stats_get(const splinterdb *kvs, splinterdb_stats *stats);
+
+/*
+ * Cache Resize
+ *
+ * splinterdb_cache_resize() grows or shrinks the cache to cache_size bytes,
+ * up to the cache_max_size config option, while other threads go on using
+ * it. Pages in the part of the cache being removed are written back and
+ * evicted, and their memory given back to the system.
+ *
+ * Returns EINVAL if cache_size is larger than cache_max_size or not a multiple
+ * of 64 pages, and EAGAIN if pinned pages, such as those of memtables being
+ * filled, keep the cache from shrinking for a few seconds; the cache is then
+ * left as it was. Must be called from a registered thread.
+ */
+int
+splinterdb_cache_resize(splinterdb *kvs, uint64 cache_size);
+
 #endif // _SPLINTERDB_H_